@@ -8,5 +8,9 @@ constexpr size_t DIM = 9;
 constexpr size_t SIZE = DIM + 1;
 
 using WordIndex = uint32_t;
+using WordScore = float;
+
+// Score given to words in the word list that don't have an explicit "word;score" entry
+constexpr WordScore DEFAULT_WORD_SCORE = 50;
 
 constexpr size_t NUM_THREADS = 6;
\ No newline at end of file
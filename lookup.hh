@@ -6,6 +6,9 @@
 #include <cstddef>
 #include <filesystem>
 #include <map>
+#include <charconv>
+#include <cmath>
+#include <format>
 
 #include "constants.hh"
 #include "flat_vector.hh"
@@ -47,13 +50,29 @@ public:
         std::ifstream file(fname);
         std::string word;
 
+        for (auto& s : max_score_by_length_) s = 0;
+
+        // Each entry is either "word" or "word;score", the score is optional, must be finite and non-negative and is used
+        // to rank candidates
         while (file >> word) {
+            WordScore score = DEFAULT_WORD_SCORE;
+            if (size_t split = word.find(';'); split != std::string::npos) {
+                const char* begin = word.data() + split + 1;
+                const char* end = word.data() + word.size();
+                auto [ptr, ec] = std::from_chars(begin, end, score);
+                if (ec != std::errc() || ptr != end || !std::isfinite(score) || score < 0) {
+                    throw std::runtime_error(std::format("Invalid score in word list entry '{}'", word));
+                }
+                word.resize(split);
+            }
             if (word.size() <= 1 || word.size() > DIM) {
                 continue;
             }
             size_t index = words_.size();
             add_to_cache(word, index);
+            max_score_by_length_[word.size()] = std::max(max_score_by_length_[word.size()], score);
             words_.push_back(std::move(word));
+            scores_.push_back(score);
         }
         std::cout << "Loaded " << words_.size() << " words\n";
     }
@@ -78,6 +97,10 @@ public:
     }
 
     const std::string& word(size_t index) const { return words_.at(index); }
+    WordScore score(size_t index) const { return scores_.at(index); }
+
+    // Best score of any word with the given length, used as an optimistic bound for unfilled openings
+    WordScore max_score(size_t opening) const { return max_score_by_length_.at(opening); }
 
 private:
     static size_t to_index(char c) { return std::tolower(c) - 'a'; }
@@ -105,6 +128,8 @@ private:
         }
     }
     std::vector<std::string> words_;
+    std::vector<WordScore> scores_;
+    std::array<WordScore, SIZE> max_score_by_length_;
     std::array<std::vector<WordIndex>, SIZE> words_by_length_;
     std::array<std::unordered_map<LookupQuery, std::vector<WordIndex>>, SIZE> cache_;
 };
@@ -10,6 +10,9 @@
 #include <set>
 #include <fstream>
 #include <thread>
+#include <mutex>
+#include <cmath>
+#include <limits>
 
 #include <filesystem>
 
@@ -209,6 +212,9 @@ private:
 
         uint16_t used_words = 0;
 
+        // Sum of the scores of each used word
+        double score = 0.0;
+
         union Contained {
             const std::vector<Board::Index>* to_visit;
             WordIndex word;
@@ -246,13 +252,17 @@ public:
         return false;
     }
 
+    size_t depth(const Dfs& current) const { return current.used_words; }
+    double score(const Dfs& current) const { return current.score; }
+
     const Board& board(const Dfs& current) const {
         return current.board;
     }
 
-    void push(Dfs current, Board new_board, size_t index) {
+    void push(Dfs current, Board new_board, size_t index, WordScore score) {
         current.board = std::move(new_board);
         current.contained[current.used_words++].word = index;
+        current.score += score;
         data_.push(std::move(current));
     }
 
@@ -302,23 +312,112 @@ std::vector<const std::vector<Board::Index>*> alternating_shuffle(const Board::W
     return result;
 }
 
+struct SearchOptions {
+    // When set the search runs in anytime mode: only fills that beat the best one so far are reported, partial fills
+    // that can't beat it are pruned and every thread stops once the budget has elapsed
+    std::optional<std::chrono::milliseconds> time_budget;
+
+    // In anytime mode, stop as soon as a fill averages at least this score per word
+    std::optional<WordScore> target_score;
+
+    // Weight of the lookahead term (log2 of the fewest candidates left for any crossing opening) added to the word
+    // score when ranking candidates
+    double lookahead_weight = 10.0;
+};
+
+// The best complete fill found so far, shared between all of the threads
+class BestFill {
+public:
+    // target is the total score at which a fill is good enough for every thread to stop
+    explicit BestFill(std::optional<double> target) : target_(target) {}
+
+    double score() const { return score_.load(std::memory_order_relaxed); }
+    bool reached_target() const { return reached_target_.load(std::memory_order_relaxed); }
+
+    bool offer(double score, const Board& board) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (board_ && score <= score_) return false;
+        score_ = score;
+        board_ = board;
+        if (target_ && score >= *target_) reached_target_ = true;
+        return true;
+    }
+
+    std::optional<Board> board() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return board_;
+    }
+
+private:
+    const std::optional<double> target_;
+
+    mutable std::mutex mutex_;
+    std::atomic<double> score_ = -std::numeric_limits<double>::infinity();
+    std::atomic<bool> reached_target_ = false;
+    std::optional<Board> board_;
+};
+
+bool shares_square(const std::vector<Board::Index>& first, const std::vector<Board::Index>& second) {
+    for (const Board::Index index : first) {
+        if (std::find(second.begin(), second.end(), index) != second.end()) return true;
+    }
+    return false;
+}
+
 void run(
     const std::string& name,
     Board b,
     const Board::WordIndicies& word_index,
     const Lookup& lookup,
+    const SearchOptions& options,
+    BestFill& best,
     std::atomic<bool>& should_print) {
 
     std::vector<const std::vector<Board::Index>*> to_visit = alternating_shuffle(word_index);
     DfsHelper dfs_helper(b, to_visit);
 
+    // For each opening, the openings visited after it which share at least one square
+    std::vector<std::vector<size_t>> crossings(to_visit.size());
+    for (size_t i = 0; i < to_visit.size(); ++i) {
+        for (size_t j = i + 1; j < to_visit.size(); ++j) {
+            if (shares_square(*to_visit[i], *to_visit[j])) {
+                crossings[i].push_back(j);
+            }
+        }
+    }
+
+    // Optimistic score for filling every opening from the given depth onwards
+    std::vector<double> remaining_bound(to_visit.size() + 1, 0.0);
+    for (size_t i = to_visit.size(); i-- > 0;) {
+        remaining_bound[i] = remaining_bound[i + 1] + lookup.max_score(to_visit[i]->size());
+    }
+
+    const bool anytime = options.time_budget.has_value();
+    const Timer::time_point deadline = anytime ? start + *options.time_budget : Timer::time_point::max();
+    auto should_stop = [&]() { return best.reached_target() || Timer::now() >= deadline; };
+
     size_t boards_checked = 0;
     Timer::time_point previous = start;
 
+    struct Ranked {
+        double key;
+        WordIndex index;
+        Board board;
+    };
+    std::vector<Ranked> ranked;
+
     size_t start_index = start_index_dist(gen);
     while (auto current = dfs_helper.pop()) {
         boards_checked++;
 
+        if (anytime && boards_checked % 1024 == 0 && should_stop()) {
+            break;
+        }
+
+        if (anytime && dfs_helper.score(*current) + remaining_bound[dfs_helper.depth(*current)] <= best.score()) {
+            continue;
+        }
+
         if (boards_checked % 100000 == 0) {
             bool expected = true;
             if (should_print.compare_exchange_weak(expected, false)) {
@@ -339,20 +438,37 @@ void run(
         // std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
         if (indicies == nullptr) {
-            std::cout << "\nDONE\n";
+            const double score = dfs_helper.score(*current);
+            if (anytime && !best.offer(score, dfs_helper.board(*current))) {
+                continue;
+            }
+            std::cout << std::format("\nDONE (average score {:.2f})\n", score / to_visit.size());
             std::cout << dfs_helper.board(*current).to_string() << "\n";
             std::filesystem::path path = std::format("/tmp/crossword_{}x{}_{}_{}.ipuz", DIM, DIM, boards_checked, name);
             write_ipuz(dfs_helper.board(*current), word_index, path);
             std::cout << "Wrote data to " << path.string() << "\n\n";
-            dfs_helper.pop();
+            if (!anytime) dfs_helper.pop();
             continue;
         }
 
         const auto positions = dfs_helper.board(*current).get_characters_at(*indicies);
         const auto& candidates = lookup.words_with_characters_at(positions, indicies->size());
+        const auto& crossing = crossings[dfs_helper.depth(*current)];
+        const double child_bound = dfs_helper.score(*current) + remaining_bound[dfs_helper.depth(*current) + 1];
         size_t this_start_index = start_index++;
+        ranked.clear();
+        bool stopped = false;
         for (size_t i = 0; i < candidates.size(); ++i) {
-            const size_t index = candidates[(this_start_index + i) % candidates.size()];
+            // A single expansion can cover tens of thousands of words, so don't let it run past the deadline
+            if (anytime && i % 256 == 255 && should_stop()) {
+                stopped = true;
+                break;
+            }
+
+            const WordIndex index = candidates[(this_start_index + i) % candidates.size()];
+            if (anytime && child_bound + lookup.score(index) <= best.score()) {
+                continue;
+            }
             if (dfs_helper.used_word(*current, index)) {
                 continue;
             }
@@ -366,10 +482,35 @@ void run(
                 new_board.set_index((*indicies)[j], candidate[j]);
             }
 
-            if (i == candidates.size() - 1) {
-                dfs_helper.push(std::move(*current), new_board, index);
+            // Lookahead, drop the candidate if it leaves a crossing opening without any words
+            size_t fewest = std::numeric_limits<size_t>::max();
+            for (const size_t j : crossing) {
+                const auto crossing_positions = new_board.get_characters_at(*to_visit[j]);
+                fewest = std::min(fewest, lookup.words_with_characters_at(crossing_positions, to_visit[j]->size()).size());
+                if (fewest == 0) break;
+            }
+            if (fewest == 0) {
+                continue;
+            }
+
+            double key = lookup.score(index);
+            if (!crossing.empty()) key += options.lookahead_weight * std::log2(1.0 + fewest);
+            ranked.push_back({key, index, std::move(new_board)});
+        }
+
+        if (stopped) {
+            break;
+        }
+
+        // The stack pops the last element first, so push the best ranked candidate last. Stable so ties keep the
+        // rotated dictionary order.
+        std::stable_sort(ranked.begin(), ranked.end(), [](const Ranked& lhs, const Ranked& rhs) { return lhs.key < rhs.key; });
+        for (size_t i = 0; i < ranked.size(); ++i) {
+            const WordScore score = lookup.score(ranked[i].index);
+            if (i == ranked.size() - 1) {
+                dfs_helper.push(std::move(*current), std::move(ranked[i].board), ranked[i].index, score);
             } else {
-                dfs_helper.push(*current, new_board, index);
+                dfs_helper.push(*current, std::move(ranked[i].board), ranked[i].index, score);
             }
         }
     }
@@ -399,30 +540,50 @@ int main() {
 
     start = Timer::now();
 
+    SearchOptions options;
+    options.time_budget = std::chrono::seconds(30);
+    options.target_score = 80;
+
+    const size_t words = word_index.rows.size() + word_index.cols.size();
+    BestFill best(options.target_score ? std::optional<double>(*options.target_score * words) : std::nullopt);
     std::atomic<bool> should_print = false;
     std::vector<std::thread> threads;
-    std::vector<bool> done;
+    std::atomic<size_t> finished = 0;
 
     for (size_t thread = 0; thread < NUM_THREADS; ++thread) {
-        done.push_back(false);
         std::string name = "thread" + std::to_string(thread);
         std::cout << "Spawning " << name << "\n";
         threads.push_back(std::thread([&, name](){
-            run(name, b, word_index, lookup, should_print);
-            done[thread] = true;
+            run(name, b, word_index, lookup, options, best, should_print);
+            finished++;
         }));
     }
 
     std::cout << b.to_string() << "\n";
 
-    while (!std::all_of(done.begin(), done.end(), [](bool b){ return b; })) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-        should_print = true;
+    // Poll often enough in anytime mode that the best fill is reported close to the budget
+    std::chrono::milliseconds poll = std::chrono::seconds(5);
+    if (options.time_budget) poll = std::clamp(*options.time_budget / 50, std::chrono::milliseconds(1), poll);
+    Timer::time_point next_print = Timer::now() + std::chrono::seconds(5);
+    while (finished < NUM_THREADS) {
+        std::this_thread::sleep_for(poll);
+        if (Timer::now() >= next_print) {
+            should_print = true;
+            next_print += std::chrono::seconds(5);
+        }
     }
 
     for (auto& t : threads) {
         if (t.joinable()) t.join();
     }
 
+    if (auto board = best.board()) {
+        std::cout << std::format("Best fill (average score {:.2f}):\n", best.score() / words);
+        std::cout << board->to_string() << "\n";
+        std::filesystem::path path = std::format("/tmp/crossword_{}x{}_best.ipuz", DIM, DIM);
+        write_ipuz(*board, word_index, path);
+        std::cout << "Wrote data to " << path.string() << "\n";
+    }
+
     return 0;
 }
\ No newline at end of file